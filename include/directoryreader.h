@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <memory>
+
+class QDirIterator;
+
+struct DirectoryEntry {
+    enum Type { File, Directory, Symlink, Unknown };
+
+    QString name;
+    Type type;
+};
+
+// Reads a single directory level in batches without stat'ing entries. On
+// Linux each batch is one getdents64 call; elsewhere QDirIterator is used.
+// Special files are always skipped; hidden entries only when asked to.
+class DirectoryReader {
+public:
+    DirectoryReader(const QString& path, bool includeHidden);
+    ~DirectoryReader();
+
+    DirectoryReader(const DirectoryReader&) = delete;
+    DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+    // Replaces entries with the next batch; returns false once exhausted
+    bool readBatch(QVector<DirectoryEntry>& entries);
+
+private:
+#ifdef Q_OS_LINUX
+    int fd;
+    bool includeHidden;
+    std::unique_ptr<char[]> buffer;
+#else
+    std::unique_ptr<QDirIterator> iterator;
+#endif
+};
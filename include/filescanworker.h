@@ -11,6 +11,9 @@
 #include <queue>
 #include <mutex>
 #include <atomic>
+#include "scanfilter.h"
+#include "iothrottle.h"
+#include "scanprogress.h"
 
 struct FileInfo {
     QString path;
@@ -32,12 +35,18 @@ class FileScanWorker : public QObject {
 public:
     explicit FileScanWorker(QObject *parent = nullptr);
 
+    // Replaces the exclusion rules; must not be called while a scan is running
+    void setScanFilter(const ScanFilter& filter);
+
+    // Low-priority, rate-limited scanning; must not be called while a scan is running
+    void setBackgroundMode(const BackgroundScanSettings& settings);
+
 public slots:
     void startScan(const QString& directory, qint64 minSize = 0);
     void stop();
 
 signals:
-    void scanProgress(int percentage);
+    void scanProgress(const ScanProgress& progress);
     void scanComplete(const QList<FileInfo>& files);
     void error(const QString& message);
 
@@ -45,8 +54,12 @@ private:
     void processBatch(const QVector<QPair<QString, QFileInfo>>& batch,
                      QList<FileInfo>& results,
                      QHash<QString, QString>& fileTypeCache,
-                     std::atomic<qint64>& totalProcessedSize);
+                     ScanProgressTracker& progress,
+                     IoThrottle* throttle);
 
-    bool shouldStop;
+    std::atomic<bool> shouldStop;
     qint64 minimumSize;
+    ScanFilter scanFilter;
+    BackgroundScanSettings backgroundSettings;
+    QHash<QString, qint64> directoryEntryCounts;
 }; 
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+// Settings for scanning live hosts without starving foreground I/O
+struct BackgroundScanSettings {
+    bool enabled = false;
+    int maxThreads = 2;
+    double metadataOpsPerSecond = 2000.0;       // stat/readdir calls, <= 0 for unlimited
+    double bytesPerSecond = 8.0 * 1024 * 1024;  // content read for type sniffing
+    double latencySpikeFactor = 4.0;            // backoff when stat latency exceeds baseline by this
+    double minimumRateScale = 1.0 / 16;         // slowest the adaptive backoff may throttle to
+};
+
+// Thread-safe token bucket. Callers take tokens up front and sleep off any
+// debt, so concurrent callers are serialized fairly without a wait queue.
+class TokenBucket {
+public:
+    TokenBucket(double ratePerSecond, double burst);
+
+    // Sleeps in short slices so a cancelled scan is not held up by debt
+    void acquire(double tokens, const std::atomic<bool>& cancelled);
+    void setRateScale(double scale);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void refill(Clock::time_point now);
+
+    const double rate;
+    const double capacity;
+    double scale;
+    double available;
+    Clock::time_point lastRefill;
+    std::mutex mutex;
+};
+
+// Metadata and read budgets for a background scan, with the effective rate
+// halved whenever stat latency spikes above its recent average and slowly
+// restored after. Waits end early once cancelled is set.
+class IoThrottle {
+public:
+    IoThrottle(const BackgroundScanSettings& settings, const std::atomic<bool>& cancelled);
+
+    // Idle I/O class and idle CPU scheduling for the calling thread
+    static void lowerCurrentThreadPriority();
+
+    void acquireMetadata(int operations);
+    void acquireBytes(qint64 bytes);
+    void recordMetadataLatency(qint64 nanoseconds, int operations);
+
+private:
+    const BackgroundScanSettings settings;
+    const std::atomic<bool>& cancelled;
+    TokenBucket metadataBucket;
+    TokenBucket byteBucket;
+
+    std::mutex latencyMutex;
+    double baselineNanosPerOp;
+    double rateScale;
+};
@@ -24,7 +24,7 @@ public:
 private slots:
     void handleSelectDirectory();
     void handleStartScan();
-    void handleScanProgress(int progress);
+    void handleScanProgress(const ScanProgress& progress);
     void handleScanComplete(const QList<FileInfo>& files);
     void handleDeleteSelected();
     void handleOpenFileLocation();
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QTimer>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "scanindex.h"
+
+class QLocalSocket;
+class QThread;
+
+// Keeps a scan index per configured root up to date and answers queries on
+// a local socket. The protocol is one JSON object per line in each
+// direction, e.g. {"query":"files","root":"/data","limit":10}.
+class ScanDaemon : public QObject {
+    Q_OBJECT
+
+public:
+    ScanDaemon(const QStringList& roots, int rescanIntervalSeconds,
+               bool background, const ScanFilter& filter, QObject *parent = nullptr);
+    ~ScanDaemon();
+
+    // Fails rather than taking over a socket another daemon still answers on
+    bool listen(const QString& socketPath, QLocalServer::SocketOptions access,
+                QString& errorMessage);
+
+    static QString defaultSocketPath();
+
+    // Sends a single request line to a running daemon and returns the reply
+    static bool query(const QString& socketPath, const QByteArray& request,
+                      QByteArray& reply, QString& errorMessage);
+
+private slots:
+    void handleNewConnection();
+
+private:
+    struct Root {
+        QString path;
+        QThread *thread;
+        FileScanWorker *worker;
+        QTimer *rescanTimer; // Single-shot, started when a scan finishes
+        std::shared_ptr<const ScanIndex> snapshot;
+        QString error;       // Why the last scan failed, if it did
+        bool scanning;
+    };
+
+    void startScan(Root *root);
+    void finishScan(Root *root, std::shared_ptr<const ScanIndex> snapshot, const QString& error);
+    void handleReadyRead(QLocalSocket *socket);
+    QJsonObject handleRequest(const QJsonObject& request);
+    std::shared_ptr<const ScanIndex> snapshotFor(const QString& root, QString& errorMessage);
+
+    std::vector<std::unique_ptr<Root>> roots;
+    std::mutex snapshotMutex; // Guards Root::snapshot, Root::error and Root::scanning
+    QLocalServer *server;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QVector>
+#include <QRegularExpression>
+#include <vector>
+#include <mutex>
+
+class IoThrottle;
+
+// Exclusion rules applied while traversing, before a directory is opened.
+// Path prefixes are stored as a trie of path components so that each
+// directory only costs one hash lookup against its parent's trie node.
+class ScanFilter {
+public:
+    // Position in the path trie; NoCursor means no excluded path lies below
+    using Cursor = int;
+    static constexpr Cursor NoCursor = -1;
+
+    ScanFilter();
+
+    // Pseudo filesystems, snapshot directories and network/virtual mounts
+    static ScanFilter defaults();
+
+    void excludePath(const QString& prefix);
+    void excludeName(const QString& glob);
+    void excludeFileSystemType(const QString& type);
+    void setDetectLoops(bool enabled) { detectLoops = enabled; }
+    void setSkipHidden(bool enabled) { skipHidden = enabled; }
+
+    Cursor rootCursor(const QString& rootPath) const;
+    Cursor childCursor(Cursor parent, const QString& name) const;
+    bool isPathExcluded(Cursor cursor) const;
+    bool excludesPath(const QString& path) const; // Walks the trie; off the hot path
+    bool isNameExcluded(const QString& name) const;
+    bool isFileSystemTypeExcluded(const QString& type) const;
+    bool hasFileSystemTypeRules() const { return !fileSystemTypes.isEmpty(); }
+    bool loopDetectionEnabled() const { return detectLoops; }
+    bool skipsHidden() const { return skipHidden; }
+
+private:
+    struct PathNode {
+        QHash<QString, int> children;
+        bool excluded = false;
+    };
+
+    std::vector<PathNode> pathNodes; // Index 0 is the filesystem root
+    QSet<QString> exactNames;
+    QVector<QRegularExpression> namePatterns;
+    QSet<QString> fileSystemTypes;
+    bool detectLoops;
+    bool skipHidden;
+};
+
+// Per-scan pruning state shared by all worker threads: the (device, inode)
+// pairs of directories already visited and the filesystem type of each
+// device encountered, so mounts are only classified once.
+class ScanPruner {
+public:
+    // The stat calls made while pruning are charged to throttle, if given
+    ScanPruner(const ScanFilter& filter, const QString& rootPath, IoThrottle *throttle = nullptr);
+
+    ScanFilter::Cursor rootCursor() const { return root; }
+
+    // Decides whether a subdirectory should be queued. On success the trie
+    // cursor for the subdirectory is written to childCursor.
+    bool shouldDescend(const QString& path, const QString& name,
+                       ScanFilter::Cursor parentCursor,
+                       ScanFilter::Cursor& childCursor);
+
+private:
+    bool isDeviceExcluded(quint64 device, const QString& path);
+
+    const ScanFilter& filter;
+    IoThrottle *throttle;
+    ScanFilter::Cursor root;
+    quint64 rootDevice;
+
+    QSet<QPair<quint64, quint64>> visited;
+    std::mutex visitedMutex;
+
+    QHash<quint64, bool> deviceExcluded;
+    std::mutex deviceMutex;
+};
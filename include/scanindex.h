@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QString>
+#include <QDateTime>
+#include <QHash>
+#include <QVector>
+#include <memory>
+#include "filescanworker.h"
+
+struct DirectoryTotal {
+    QString path;
+    qint64 size;
+    qint64 fileCount;
+};
+
+struct TypeTotal {
+    qint64 fileCount = 0;
+    qint64 size = 0;
+};
+
+// Query-ready results of one completed scan. Built once and never modified,
+// so any number of readers can hold a snapshot while a newer one is built.
+struct ScanIndex {
+    QString root;
+    QDateTime scannedAt;
+    qint64 totalSize = 0;
+    QList<FileInfo> files;                 // Largest first
+    QVector<DirectoryTotal> directories;   // Recursive totals, largest first
+    QHash<QString, TypeTotal> typeTotals;  // Keyed by MIME type
+
+    // Files must already be largest first, as scanComplete delivers them;
+    // the list is shared rather than copied
+    static std::shared_ptr<const ScanIndex> build(const QString& root, QList<FileInfo> files);
+};
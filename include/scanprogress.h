@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QString>
+#include <QElapsedTimer>
+#include <atomic>
+
+class ScanFilter;
+
+// Snapshot of scan progress, emitted at a fixed rate regardless of tree shape
+struct ScanProgress {
+    int percentage = 0;          // 0-100, estimated from the filesystem's usage
+    qint64 filesScanned = 0;
+    qint64 bytesScanned = 0;
+    qint64 directoriesScanned = 0;
+    double filesPerSecond = 0;
+    double bytesPerSecond = 0;
+    qint64 etaSeconds = -1;      // -1 until there is enough data for an estimate
+};
+
+// Counters updated by scan threads with relaxed atomics and sampled by a
+// single reader. Totals come from statvfs of the scanned filesystem plus
+// every mount below the root that the filter does not prune. They are
+// exact when scanning a mount point and an upper bound otherwise.
+class ScanProgressTracker {
+public:
+    // Sampling interval used by the scan loop
+    static constexpr int SampleIntervalMs = 200;
+
+    ScanProgressTracker(const QString& rootPath, const ScanFilter& filter);
+
+    void addFiles(qint64 count, qint64 bytes) {
+        files.fetch_add(count, std::memory_order_relaxed);
+        this->bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void addDirectory() {
+        directories.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ScanProgress sample() const;
+
+private:
+    void addVolumeUsage(const QString& path);
+
+    std::atomic<qint64> files{0};
+    std::atomic<qint64> bytes{0};
+    std::atomic<qint64> directories{0};
+
+    qint64 estimatedBytes;
+    qint64 estimatedFiles;
+    QElapsedTimer elapsed;
+};
@@ -0,0 +1,96 @@
+#include "directoryreader.h"
+#include <QDirIterator>
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdint>
+
+// glibc does not declare this; layout from getdents64(2)
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Large enough for a few thousand entries per system call
+static constexpr int ReadBufferSize = 256 * 1024;
+
+DirectoryReader::DirectoryReader(const QString& path, bool includeHidden)
+    : fd(::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      includeHidden(includeHidden),
+      buffer(fd >= 0 ? new char[ReadBufferSize] : nullptr) {}
+
+DirectoryReader::~DirectoryReader() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool DirectoryReader::readBatch(QVector<DirectoryEntry>& entries) {
+    entries.clear();
+
+    while (fd >= 0) {
+        long bytes = syscall(SYS_getdents64, fd, buffer.get(), ReadBufferSize);
+        if (bytes <= 0) {
+            ::close(fd);
+            fd = -1;
+            break;
+        }
+
+        for (long offset = 0; offset < bytes;) {
+            const auto* dirent = reinterpret_cast<const LinuxDirent64*>(buffer.get() + offset);
+            offset += dirent->d_reclen;
+
+            const char *name = dirent->d_name;
+            if (name[0] == '.') {
+                if (!includeHidden) continue;
+                if (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')) continue;
+            }
+
+            DirectoryEntry::Type type;
+            switch (dirent->d_type) {
+            case DT_REG: type = DirectoryEntry::File; break;
+            case DT_DIR: type = DirectoryEntry::Directory; break;
+            case DT_LNK: type = DirectoryEntry::Symlink; break;
+            case DT_UNKNOWN: type = DirectoryEntry::Unknown; break;
+            default: continue; // Devices, sockets and pipes
+            }
+
+            entries.append({QFile::decodeName(dirent->d_name), type});
+        }
+
+        // A batch made up only of skipped entries is not the end of the directory
+        if (!entries.isEmpty()) return true;
+    }
+
+    return false;
+}
+
+#else
+
+static constexpr int EntriesPerBatch = 1024;
+
+DirectoryReader::DirectoryReader(const QString& path, bool includeHidden)
+    : iterator(std::make_unique<QDirIterator>(path, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot
+                                                        | (includeHidden ? QDir::Filters(QDir::Hidden) : QDir::Filters()))) {}
+
+DirectoryReader::~DirectoryReader() = default;
+
+bool DirectoryReader::readBatch(QVector<DirectoryEntry>& entries) {
+    entries.clear();
+
+    while (entries.size() < EntriesPerBatch && iterator->hasNext()) {
+        iterator->next();
+        QFileInfo fileInfo = iterator->fileInfo();
+        entries.append({fileInfo.fileName(),
+                        fileInfo.isDir() ? DirectoryEntry::Directory : DirectoryEntry::File});
+    }
+
+    return !entries.isEmpty();
+}
+
+#endif
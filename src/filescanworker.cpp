@@ -1,6 +1,10 @@
 #include "filescanworker.h"
 #include "fileutils.h"
-#include <QDirIterator>
+#include "scanfilter.h"
+#include "iothrottle.h"
+#include "scanprogress.h"
+#include "directoryreader.h"
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QThread>
 #include <QtConcurrent>
@@ -9,15 +13,40 @@
 #include <mutex>
 #include <atomic>
 
+// Upper bound on what MIME sniffing reads from a file's head
+static constexpr qint64 SniffReadBytes = 16 * 1024;
+
+// Files are stat'ed inline in batches of this size
+static constexpr int SmallBatchSize = 100;
+
+// Past this many entries a directory's stat work is split into chunks that
+// idle threads can steal, so one huge directory does not serialize the scan
+static constexpr qint64 LargeDirectoryEntries = 4096;
+static constexpr int StatChunkSize = 1024;
+
+// A unit of work: a directory to list along with its position in the
+// exclusion path trie, or a chunk of files split off a large directory
+struct ScanTask {
+    QString path;
+    ScanFilter::Cursor cursor = ScanFilter::NoCursor;
+    QVector<QPair<QString, QFileInfo>> files;
+};
+
 // Work-stealing queue for better load balancing
 class WorkQueue {
 public:
-    void push(const QString& dir) {
+    void push(ScanTask dir) {
+        std::lock_guard<std::mutex> lock(mutex);
+        dirs.push_back(std::move(dir));
+    }
+
+    // The owner pops from the front, so this runs the task next
+    void pushFront(ScanTask dir) {
         std::lock_guard<std::mutex> lock(mutex);
-        dirs.push_back(dir);
+        dirs.push_front(std::move(dir));
     }
 
-    bool pop(QString& dir) {
+    bool pop(ScanTask& dir) {
         std::lock_guard<std::mutex> lock(mutex);
         if (dirs.empty()) return false;
         dir = std::move(dirs.front());
@@ -25,7 +54,7 @@ public:
         return true;
     }
 
-    bool steal(QString& dir) {
+    bool steal(ScanTask& dir) {
         std::lock_guard<std::mutex> lock(mutex);
         if (dirs.empty()) return false;
         dir = std::move(dirs.back());
@@ -34,48 +63,84 @@ public:
     }
 
 private:
-    std::deque<QString> dirs;
+    std::deque<ScanTask> dirs;
     std::mutex mutex;
 };
 
 FileScanWorker::FileScanWorker(QObject *parent)
-    : QObject(parent), shouldStop(false), minimumSize(0) {}
+    : QObject(parent), shouldStop(false), minimumSize(0), scanFilter(ScanFilter::defaults()) {}
+
+void FileScanWorker::setScanFilter(const ScanFilter& filter) {
+    scanFilter = filter;
+}
+
+void FileScanWorker::setBackgroundMode(const BackgroundScanSettings& settings) {
+    backgroundSettings = settings;
+}
 
 void FileScanWorker::startScan(const QString& directory, qint64 minSize) {
     shouldStop = false;
     minimumSize = minSize;
 
+    const QFileInfo rootInfo(directory);
+    if (!rootInfo.isDir() || !rootInfo.isReadable()) {
+        emit error(QString("Cannot read directory %1").arg(directory));
+        return;
+    }
+
     // Create thread pool for parallel scanning
     QThreadPool threadPool;
-    const int maxThreads = std::max(1, QThread::idealThreadCount() - 1);
+    int maxThreads = std::max(1, QThread::idealThreadCount() - 1);
+    if (backgroundSettings.enabled) {
+        maxThreads = std::clamp(backgroundSettings.maxThreads, 1, maxThreads);
+    }
     threadPool.setMaxThreadCount(maxThreads);
 
+    // Background mode budgets metadata and read operations across all threads
+    std::unique_ptr<IoThrottle> throttle;
+    if (backgroundSettings.enabled) {
+        throttle = std::make_unique<IoThrottle>(backgroundSettings, shouldStop);
+    }
+
     // Create work queues for each thread
     std::vector<std::unique_ptr<WorkQueue>> workQueues(maxThreads);
     for (int i = 0; i < maxThreads; ++i) {
         workQueues[i] = std::make_unique<WorkQueue>();
     }
 
+    // Pruning state (visited inodes, mount types) lives for this scan only
+    ScanPruner pruner(scanFilter, directory, throttle.get());
+
     // Initialize the first queue with the root directory
-    workQueues[0]->push(directory);
+    workQueues[0]->push({directory, pruner.rootCursor()});
 
     // Shared data structures
     QList<FileInfo> results;
     std::mutex resultsMutex;
-    std::atomic<qint64> totalProcessedSize{0};
+    ScanProgressTracker progress(directory, scanFilter);
     std::atomic<int> activeThreads{maxThreads};
 
+    // Entry counts of large directories seen by earlier scans, read-only while threads run
+    const QHash<QString, qint64>& knownEntryCounts = directoryEntryCounts;
+    QHash<QString, qint64> scanEntryCounts;
+
     // Create worker functions for parallel processing
-    auto scanFunction = [this, &workQueues, &results, &resultsMutex, &totalProcessedSize, 
-                        &activeThreads, directory, maxThreads](int threadId) {
+    auto scanFunction = [this, &workQueues, &results, &resultsMutex, &progress,
+                        &activeThreads, &pruner, &throttle, &knownEntryCounts, &scanEntryCounts,
+                        directory, maxThreads](int threadId) {
+        if (throttle) {
+            IoThrottle::lowerCurrentThreadPriority();
+        }
+
         QList<FileInfo> threadResults;
         threadResults.reserve(1000); // Pre-allocate space for batch processing
 
         // Local cache for file type lookups
         QHash<QString, QString> fileTypeCache;
+        QHash<QString, qint64> threadEntryCounts;
 
         while (!shouldStop) {
-            QString currentDir;
+            ScanTask currentDir;
             bool hasWork = false;
 
             // Try to get work from own queue
@@ -97,39 +162,84 @@ void FileScanWorker::startScan(const QString& directory, qint64 minSize) {
                 continue;
             }
 
-            // Use recursive iterator to process entire subtree
-            QDirIterator it(currentDir, 
-                          QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot,
-                          QDirIterator::Subdirectories);
+            if (!currentDir.files.isEmpty()) {
+                // Stat work split off a large directory by another thread
+                processBatch(currentDir.files, threadResults, fileTypeCache, progress, throttle.get());
+            } else {
+                // List a single level; subdirectories are queued so exclusion
+                // rules are applied before they are ever opened
+                DirectoryReader reader(currentDir.path, !scanFilter.skipsHidden());
+                QVector<DirectoryEntry> entries;
+                const QString prefix = currentDir.path.endsWith('/') ? currentDir.path : currentDir.path + '/';
 
-            // Batch process files
-            QVector<QPair<QString, QFileInfo>> batch;
-            batch.reserve(100);
+                // Directories known to be huge are split from their first entry
+                qint64 entryCount = 0;
+                bool splitting = knownEntryCounts.value(currentDir.path) >= LargeDirectoryEntries;
 
-            while (it.hasNext() && !shouldStop) {
-                QString filePath = it.next();
-                QFileInfo fileInfo = it.fileInfo();
+                QVector<QPair<QString, QFileInfo>> batch;
+                batch.reserve(splitting ? StatChunkSize : SmallBatchSize);
 
-                if (fileInfo.isDir()) {
-                    // Only queue directories that might contain large files
-                    if (fileInfo.size() >= minimumSize) {
-                        workQueues[threadId]->push(filePath);
+                while (!shouldStop) {
+                    if (throttle) {
+                        throttle->acquireMetadata(1);
                     }
-                } else {
-                    batch.append({filePath, fileInfo});
-                    
-                    // Process batch when full
-                    if (batch.size() >= 100) {
-                        processBatch(batch, threadResults, fileTypeCache, totalProcessedSize);
-                        batch.clear();
-                        batch.reserve(100);
+                    if (!reader.readBatch(entries)) break;
+
+                    entryCount += entries.size();
+                    splitting = splitting || entryCount >= LargeDirectoryEntries;
+
+                    for (const DirectoryEntry& entry : entries) {
+                        QString filePath = prefix + entry.name;
+                        QFileInfo fileInfo(filePath);
+
+                        // Only links and filesystems without d_type need a stat here
+                        bool isDir = entry.type == DirectoryEntry::Directory;
+                        if (entry.type == DirectoryEntry::Symlink || entry.type == DirectoryEntry::Unknown) {
+                            if (throttle) {
+                                throttle->acquireMetadata(1);
+                            }
+                            if (!fileInfo.exists()) continue;
+                            isDir = fileInfo.isDir();
+                        }
+
+                        if (isDir) {
+                            ScanFilter::Cursor childCursor = ScanFilter::NoCursor;
+                            if (pruner.shouldDescend(filePath, entry.name,
+                                                     currentDir.cursor, childCursor)) {
+                                // Start big directories early so their chunks spread out
+                                if (knownEntryCounts.value(filePath) >= LargeDirectoryEntries) {
+                                    workQueues[threadId]->pushFront({filePath, childCursor, {}});
+                                } else {
+                                    workQueues[threadId]->push({filePath, childCursor, {}});
+                                }
+                            }
+                            continue;
+                        }
+
+                        batch.append({filePath, fileInfo});
+                        if (batch.size() < (splitting ? StatChunkSize : SmallBatchSize)) continue;
+
+                        if (splitting) {
+                            // Hand the chunk to whichever thread is idle
+                            workQueues[threadId]->push({QString(), ScanFilter::NoCursor, std::move(batch)});
+                            batch = {};
+                            batch.reserve(StatChunkSize);
+                        } else {
+                            processBatch(batch, threadResults, fileTypeCache, progress, throttle.get());
+                            batch.clear();
+                        }
                     }
                 }
-            }
 
-            // Process remaining files in batch
-            if (!batch.isEmpty()) {
-                processBatch(batch, threadResults, fileTypeCache, totalProcessedSize);
+                // Process remaining files in batch
+                if (!batch.isEmpty()) {
+                    processBatch(batch, threadResults, fileTypeCache, progress, throttle.get());
+                }
+
+                if (entryCount >= LargeDirectoryEntries) {
+                    threadEntryCounts.insert(currentDir.path, entryCount);
+                }
+                progress.addDirectory();
             }
 
             // Submit results in batches
@@ -139,17 +249,12 @@ void FileScanWorker::startScan(const QString& directory, qint64 minSize) {
                 threadResults.clear();
                 threadResults.reserve(1000);
             }
-
-            // Update progress based on processed data size
-            qint64 processed = totalProcessedSize.load();
-            emit scanProgress(static_cast<int>((processed >> 20) & 0x7FFFFFFF)); // Convert to MB for progress
         }
 
         // Submit remaining results
-        if (!threadResults.isEmpty()) {
-            std::lock_guard<std::mutex> lock(resultsMutex);
-            results.append(threadResults);
-        }
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        results.append(threadResults);
+        scanEntryCounts.insert(threadEntryCounts);
     };
 
     // Start parallel scanning
@@ -158,11 +263,21 @@ void FileScanWorker::startScan(const QString& directory, qint64 minSize) {
         futures.append(QtConcurrent::run(&threadPool, [scanFunction, i]() { scanFunction(i); }));
     }
 
-    // Wait for all threads to complete
+    // Sample progress at a fixed rate until every scan thread has finished,
+    // so UI updates do not scale with the number of directories
+    while (!threadPool.waitForDone(ScanProgressTracker::SampleIntervalMs)) {
+        emit scanProgress(progress.sample());
+    }
+
     for (auto& future : futures) {
         future.waitForFinished();
     }
 
+    // Remember large directories so the next scan can split them immediately
+    if (!shouldStop) {
+        directoryEntryCounts = std::move(scanEntryCounts);
+    }
+
     if (!shouldStop) {
         // Sort results by size using parallel sort
         QtConcurrent::run(&threadPool, [&results]() {
@@ -177,10 +292,20 @@ void FileScanWorker::startScan(const QString& directory, qint64 minSize) {
 void FileScanWorker::processBatch(const QVector<QPair<QString, QFileInfo>>& batch,
                                 QList<FileInfo>& results,
                                 QHash<QString, QString>& fileTypeCache,
-                                std::atomic<qint64>& totalProcessedSize) {
+                                ScanProgressTracker& progress,
+                                IoThrottle* throttle) {
+    QElapsedTimer statTimer;
+    qint64 statNanos = 0;
+    qint64 batchBytes = 0;
+    if (throttle) {
+        throttle->acquireMetadata(batch.size());
+    }
+
     for (const auto& [filePath, fileInfo] : batch) {
+        if (throttle) statTimer.start();
         qint64 size = fileInfo.size();
-        totalProcessedSize += size;
+        if (throttle) statNanos += statTimer.nsecsElapsed();
+        batchBytes += size;
 
         if (size >= minimumSize) {
             FileInfo info;
@@ -196,6 +321,9 @@ void FileScanWorker::processBatch(const QVector<QPair<QString, QFileInfo>>& batc
             if (it != fileTypeCache.end()) {
                 info.fileType = it.value();
             } else {
+                if (throttle) {
+                    throttle->acquireBytes(std::min(size, SniffReadBytes));
+                }
                 info.fileType = FileUtils::getFileType(filePath);
                 fileTypeCache.insert(ext, info.fileType);
             }
@@ -204,6 +332,13 @@ void FileScanWorker::processBatch(const QVector<QPair<QString, QFileInfo>>& batc
             results.append(info);
         }
     }
+
+    // One counter update per batch keeps scan threads off a shared cache line
+    progress.addFiles(batch.size(), batchBytes);
+
+    if (throttle) {
+        throttle->recordMetadataLatency(statNanos, batch.size());
+    }
 }
 
 void FileScanWorker::stop() {
@@ -0,0 +1,120 @@
+#include "iothrottle.h"
+#include <QThread>
+#include <algorithm>
+#include <thread>
+
+#if defined(Q_OS_LINUX)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(Q_OS_MACOS)
+#include <sys/resource.h>
+#endif
+
+// Longest single sleep while paying off token debt
+static constexpr std::chrono::milliseconds MaxSleepSlice{50};
+
+// Weight of each latency sample in the moving baseline. Spikes are included
+// too, so a sustained shift (cache to disk) becomes the new normal quickly.
+static constexpr double LatencyAverageWeight = 0.05;
+
+TokenBucket::TokenBucket(double ratePerSecond, double burst)
+    : rate(ratePerSecond), capacity(burst), scale(1.0), available(burst),
+      lastRefill(Clock::now()) {}
+
+void TokenBucket::refill(Clock::time_point now) {
+    const double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+    available = std::min(capacity, available + elapsed * rate * scale);
+    lastRefill = now;
+}
+
+void TokenBucket::acquire(double tokens, const std::atomic<bool>& cancelled) {
+    if (rate <= 0) return;
+
+    Clock::time_point deadline;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        refill(Clock::now());
+        available -= tokens;
+        if (available >= 0) return;
+        deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(-available / (rate * scale)));
+    }
+
+    for (Clock::time_point now = Clock::now(); now < deadline && !cancelled; now = Clock::now()) {
+        std::this_thread::sleep_for(std::min<Clock::duration>(deadline - now, MaxSleepSlice));
+    }
+}
+
+void TokenBucket::setRateScale(double newScale) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refill(Clock::now());
+    scale = newScale;
+}
+
+IoThrottle::IoThrottle(const BackgroundScanSettings& settings, const std::atomic<bool>& cancelled)
+    : settings(settings), cancelled(cancelled),
+      // Allow about a tenth of a second of burst so batches are not split up
+      metadataBucket(settings.metadataOpsPerSecond, std::max(100.0, settings.metadataOpsPerSecond / 10)),
+      byteBucket(settings.bytesPerSecond, std::max(64.0 * 1024, settings.bytesPerSecond / 10)),
+      baselineNanosPerOp(0), rateScale(1.0) {}
+
+void IoThrottle::lowerCurrentThreadPriority() {
+#if defined(Q_OS_LINUX)
+    // glibc has no ioprio_set wrapper; values from linux/ioprio.h
+    constexpr int IoprioWhoProcess = 1;
+    constexpr int IoprioClassIdle = 3;
+    constexpr int IoprioClassShift = 13;
+    syscall(SYS_ioprio_set, IoprioWhoProcess, 0, IoprioClassIdle << IoprioClassShift);
+
+    // On Linux a pid of 0 applies to the calling thread only
+    sched_param param{};
+    sched_setscheduler(0, SCHED_IDLE, &param);
+    setpriority(PRIO_PROCESS, 0, 19);
+#elif defined(Q_OS_MACOS)
+    setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, IOPOL_THROTTLE);
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+#else
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+#endif
+}
+
+void IoThrottle::acquireMetadata(int operations) {
+    metadataBucket.acquire(operations, cancelled);
+}
+
+void IoThrottle::acquireBytes(qint64 bytes) {
+    byteBucket.acquire(static_cast<double>(bytes), cancelled);
+}
+
+void IoThrottle::recordMetadataLatency(qint64 nanoseconds, int operations) {
+    if (operations <= 0) return;
+    const double perOp = static_cast<double>(nanoseconds) / operations;
+
+    double newScale;
+    {
+        std::lock_guard<std::mutex> lock(latencyMutex);
+        if (baselineNanosPerOp <= 0) {
+            baselineNanosPerOp = perOp;
+            return;
+        }
+
+        // Compare against recent behaviour, then fold the sample in either way
+        const bool spike = perOp > baselineNanosPerOp * settings.latencySpikeFactor;
+        baselineNanosPerOp += (perOp - baselineNanosPerOp) * LatencyAverageWeight;
+
+        if (spike) {
+            // The device is contended; back off hard
+            newScale = std::max(settings.minimumRateScale, rateScale / 2);
+        } else {
+            newScale = std::min(1.0, rateScale + 0.05);
+        }
+
+        if (newScale == rateScale) return;
+        rateScale = newScale;
+    }
+
+    metadataBucket.setRateScale(newScale);
+    byteBucket.setRateScale(newScale);
+}
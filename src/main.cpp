@@ -1,15 +1,126 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QTextStream>
+#include <cstring>
 #include "mainwindow.h"
+#include "scandaemon.h"
+
+// Accepts every spelling QCommandLineParser does: --name, -name and --name=value
+static bool hasArgument(int argc, char *argv[], const char *name) {
+    const size_t length = std::strlen(name);
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (std::strcmp(arg, "--") == 0) break;
+        if (arg[0] != '-') continue;
+        arg += arg[1] == '-' ? 2 : 1;
+        if (std::strncmp(arg, name, length) == 0 && (arg[length] == '\0' || arg[length] == '=')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Daemon and query modes run without a GUI so they work on headless hosts
+static int runHeadless(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Storage Helper");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("StorageHelper");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Shared scan index served over a local socket");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions({
+        {"daemon", "Serve scan indexes for the given roots."},
+        {"root", "Directory to index (repeatable).", "path"},
+        {"rescan-interval", "Seconds between rescans of each root.", "seconds", "600"},
+        {"background", "Scan with idle I/O priority and rate limits."},
+        {"exclude-path", "Do not descend below this path (repeatable).", "path"},
+        {"exclude-name", "Do not descend into directories matching this name or glob (repeatable).", "glob"},
+        {"exclude-fstype", "Do not cross into mounts of this filesystem type (repeatable).", "type"},
+        {"skip-hidden", "Skip hidden files and directories."},
+        {"socket", "Local socket path.", "path", ScanDaemon::defaultSocketPath()},
+        {"socket-access", "Who may connect to the socket: user, group or world.", "access", "user"},
+        {"query", "Send a JSON request to a running daemon and print the reply.", "json"},
+    });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const QString socketPath = parser.value("socket");
+
+    if (parser.isSet("query")) {
+        QByteArray reply;
+        QString errorMessage;
+        if (!ScanDaemon::query(socketPath, parser.value("query").toUtf8(), reply, errorMessage)) {
+            err << "Query failed: " << errorMessage << Qt::endl;
+            return 1;
+        }
+        out << reply << Qt::endl;
+        return 0;
+    }
+
+    const QStringList roots = parser.values("root");
+    if (roots.isEmpty()) {
+        err << "At least one --root is required in daemon mode" << Qt::endl;
+        return 1;
+    }
+
+    // Command line rules extend the built-in exclusions
+    ScanFilter filter = ScanFilter::defaults();
+    // Relative paths are taken from the working directory, like --root
+    for (const QString& path : parser.values("exclude-path")) {
+        filter.excludePath(QDir::cleanPath(QDir(path).absolutePath()));
+    }
+    for (const QString& glob : parser.values("exclude-name")) filter.excludeName(glob);
+    for (const QString& type : parser.values("exclude-fstype")) filter.excludeFileSystemType(type);
+    filter.setSkipHidden(parser.isSet("skip-hidden"));
+
+    bool intervalOk = false;
+    const int rescanInterval = parser.value("rescan-interval").toInt(&intervalOk);
+    if (!intervalOk || rescanInterval <= 0) {
+        err << "--rescan-interval must be a positive number of seconds" << Qt::endl;
+        return 1;
+    }
+
+    const QString access = parser.value("socket-access");
+    QLocalServer::SocketOptions socketOptions;
+    if (access == "user") {
+        socketOptions = QLocalServer::UserAccessOption;
+    } else if (access == "group") {
+        socketOptions = QLocalServer::UserAccessOption | QLocalServer::GroupAccessOption;
+    } else if (access == "world") {
+        socketOptions = QLocalServer::WorldAccessOption;
+    } else {
+        err << "--socket-access must be user, group or world" << Qt::endl;
+        return 1;
+    }
+
+    ScanDaemon daemon(roots, rescanInterval, parser.isSet("background"), filter);
+    QString errorMessage;
+    if (!daemon.listen(socketPath, socketOptions, errorMessage)) {
+        err << "Cannot listen on " << socketPath << ": " << errorMessage << Qt::endl;
+        return 1;
+    }
+
+    return app.exec();
+}
 
 int main(int argc, char *argv[]) {
+    if (hasArgument(argc, argv, "daemon") || hasArgument(argc, argv, "query")) {
+        return runHeadless(argc, argv);
+    }
+
     QApplication app(argc, argv);
     app.setApplicationName("Storage Helper");
     app.setApplicationVersion("1.0.0");
     app.setOrganizationName("StorageHelper");
-    
+
     MainWindow window;
     window.resize(1024, 768);
     window.show();
-    
+
     return app.exec();
-} 
\ No newline at end of file
+}
\ No newline at end of file
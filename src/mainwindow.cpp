@@ -23,6 +23,7 @@ MainWindow::MainWindow(QWidget *parent)
     layout->addWidget(ui->sizeFilterCombo);
     layout->addWidget(ui->minSizeSpinBox);
     layout->addWidget(ui->fileTypeFilter);
+    layout->addWidget(ui->backgroundScanCheckBox);
     layout->addWidget(ui->startScanButton);
     layout->addWidget(ui->fileTreeView);
     layout->addWidget(ui->progressBar);
@@ -132,19 +133,37 @@ void MainWindow::handleStartScan() {
         minSize = ui->minSizeSpinBox->value() * 1024 * 1024; // Convert MB to bytes
     }
 
+    // Safe to configure here: the start button is disabled while a scan runs
+    BackgroundScanSettings background;
+    background.enabled = ui->backgroundScanCheckBox->isChecked();
+    scanWorker->setBackgroundMode(background);
+
     QMetaObject::invokeMethod(scanWorker, "startScan",
                              Q_ARG(QString, currentDirectory),
                              Q_ARG(qint64, minSize));
 }
 
-void MainWindow::handleScanProgress(int progress) {
-    ui->progressBar->setValue(progress);
+void MainWindow::handleScanProgress(const ScanProgress& progress) {
+    ui->progressBar->setValue(progress.percentage);
+
+    QString status = QString("Scanning... %1 files (%2 files/s, %3/s)")
+        .arg(progress.filesScanned)
+        .arg(qRound64(progress.filesPerSecond))
+        .arg(FileUtils::formatSize(static_cast<qint64>(progress.bytesPerSecond)));
+    if (progress.etaSeconds >= 0) {
+        status += QString(", about %1:%2 remaining")
+            .arg(progress.etaSeconds / 60)
+            .arg(progress.etaSeconds % 60, 2, 10, QChar('0'));
+    }
+    ui->statusLabel->setText(status);
 }
 
 void MainWindow::handleScanComplete(const QList<FileInfo>& files) {
     currentFiles = files;
     updateFileList(files);
     
+    ui->progressBar->setValue(100);
+
     // Re-enable UI elements
     ui->startScanButton->setEnabled(true);
     ui->selectDirButton->setEnabled(true);
@@ -0,0 +1,311 @@
+#include "scandaemon.h"
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QStandardPaths>
+#include <QThread>
+#include <algorithm>
+
+static constexpr int DefaultLimit = 20;
+static constexpr int MaxLimit = 10000;
+
+// Requests are small; anything longer without a newline is not a client
+static constexpr qint64 MaxRequestBytes = 64 * 1024;
+
+static QJsonObject errorReply(const QString& message) {
+    return QJsonObject{{"ok", false}, {"error", message}};
+}
+
+// Matches whole path components, so /data/build does not match /data/builds
+static bool isUnderPath(const QString& path, const QString& prefix) {
+    if (prefix.endsWith('/')) return path.startsWith(prefix);
+    return path == prefix || (path.startsWith(prefix) && path.at(prefix.size()) == '/');
+}
+
+static QJsonObject toJson(const FileInfo& file) {
+    return QJsonObject{
+        {"path", file.path},
+        {"size", file.size},
+        {"type", file.fileType},
+        {"modified", file.lastModified.toSecsSinceEpoch()},
+    };
+}
+
+ScanDaemon::ScanDaemon(const QStringList& rootPaths, int rescanIntervalSeconds,
+                       bool background, const ScanFilter& filter, QObject *parent)
+    : QObject(parent), server(new QLocalServer(this)) {
+    BackgroundScanSettings backgroundSettings;
+    backgroundSettings.enabled = background;
+
+    // One worker thread per root so a slow volume does not delay the others
+    for (const QString& rootPath : rootPaths) {
+        auto root = std::make_unique<Root>();
+        root->path = QDir::cleanPath(QDir(rootPath).absolutePath());
+        root->thread = new QThread(this);
+        root->worker = new FileScanWorker;
+        root->worker->setBackgroundMode(backgroundSettings);
+        root->worker->setScanFilter(filter);
+        root->worker->moveToThread(root->thread);
+        root->scanning = false;
+
+        // The interval runs from the end of one scan to the start of the
+        // next, so a slow scan never leads straight into another walk
+        root->rescanTimer = new QTimer(this);
+        root->rescanTimer->setSingleShot(true);
+        root->rescanTimer->setInterval(std::max(1, rescanIntervalSeconds) * 1000);
+
+        // Build the index on the worker thread; queries keep using the
+        // previous snapshot until the new one is swapped in
+        Root *rootPtr = root.get();
+        connect(root->worker, &FileScanWorker::scanComplete, root->worker,
+                [this, rootPtr](const QList<FileInfo>& files) {
+                    finishScan(rootPtr, ScanIndex::build(rootPtr->path, files), QString());
+                }, Qt::DirectConnection);
+        connect(root->worker, &FileScanWorker::error, root->worker,
+                [this, rootPtr](const QString& message) { finishScan(rootPtr, nullptr, message); },
+                Qt::DirectConnection);
+        connect(root->rescanTimer, &QTimer::timeout, this, [this, rootPtr]() { startScan(rootPtr); });
+
+        root->thread->start();
+        roots.push_back(std::move(root));
+    }
+
+    connect(server, &QLocalServer::newConnection, this, &ScanDaemon::handleNewConnection);
+
+    for (const auto& root : roots) {
+        startScan(root.get());
+    }
+}
+
+ScanDaemon::~ScanDaemon() {
+    for (const auto& root : roots) {
+        root->worker->stop();
+        root->thread->quit();
+        root->thread->wait();
+        delete root->worker;
+    }
+}
+
+bool ScanDaemon::listen(const QString& socketPath, QLocalServer::SocketOptions access,
+                        QString& errorMessage) {
+    QLocalSocket probe;
+    probe.connectToServer(socketPath);
+    if (probe.waitForConnected(1000)) {
+        errorMessage = "another daemon is already listening on it";
+        return false;
+    }
+
+    // Nobody answered, so any socket file is left over from an unclean shutdown
+    QLocalServer::removeServer(socketPath);
+    server->setSocketOptions(access);
+    if (!server->listen(socketPath)) {
+        errorMessage = server->errorString();
+        return false;
+    }
+    return true;
+}
+
+QString ScanDaemon::defaultSocketPath() {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (dir.isEmpty()) dir = QDir::tempPath();
+    return dir + "/storagehelper.sock";
+}
+
+bool ScanDaemon::query(const QString& socketPath, const QByteArray& request,
+                       QByteArray& reply, QString& errorMessage) {
+    QLocalSocket socket;
+    socket.connectToServer(socketPath);
+    if (!socket.waitForConnected(2000)) {
+        errorMessage = socket.errorString();
+        return false;
+    }
+
+    socket.write(request.trimmed() + '\n');
+    if (!socket.waitForBytesWritten(2000)) {
+        errorMessage = socket.errorString();
+        return false;
+    }
+
+    while (!socket.canReadLine()) {
+        if (!socket.waitForReadyRead(30000)) {
+            errorMessage = socket.errorString();
+            return false;
+        }
+    }
+
+    reply = socket.readLine().trimmed();
+    return true;
+}
+
+void ScanDaemon::startScan(Root *root) {
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        if (root->scanning) return;
+        root->scanning = true;
+    }
+
+    // The daemon keeps every file so any size filter can be answered later
+    QMetaObject::invokeMethod(root->worker, "startScan", Qt::QueuedConnection,
+                              Q_ARG(QString, root->path),
+                              Q_ARG(qint64, 0));
+}
+
+void ScanDaemon::finishScan(Root *root, std::shared_ptr<const ScanIndex> snapshot, const QString& error) {
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        if (snapshot) root->snapshot = std::move(snapshot);
+        root->error = error;
+        root->scanning = false;
+    }
+
+    // Runs on the worker thread; the timer belongs to the daemon's thread
+    QMetaObject::invokeMethod(root->rescanTimer, "start", Qt::QueuedConnection);
+}
+
+std::shared_ptr<const ScanIndex> ScanDaemon::snapshotFor(const QString& rootPath, QString& errorMessage) {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+
+    const Root *match = nullptr;
+    if (rootPath.isEmpty()) {
+        if (roots.size() == 1) {
+            match = roots.front().get();
+        } else {
+            errorMessage = "\"root\" is required when serving several roots";
+            return nullptr;
+        }
+    } else {
+        const QString cleanPath = QDir::cleanPath(rootPath);
+        for (const auto& root : roots) {
+            if (root->path == cleanPath) match = root.get();
+        }
+        if (!match) {
+            errorMessage = QString("Not serving root %1").arg(rootPath);
+            return nullptr;
+        }
+    }
+
+    // A stale index of a root that can no longer be read would be misleading
+    if (!match->error.isEmpty()) {
+        errorMessage = match->error;
+        return nullptr;
+    }
+    if (!match->snapshot) {
+        errorMessage = QString("Initial scan of %1 has not finished").arg(match->path);
+    }
+    return match->snapshot;
+}
+
+void ScanDaemon::handleNewConnection() {
+    while (server->hasPendingConnections()) {
+        QLocalSocket *socket = server->nextPendingConnection();
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { handleReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void ScanDaemon::handleReadyRead(QLocalSocket *socket) {
+    while (socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty()) continue;
+
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+
+        QJsonObject reply;
+        if (parseError.error != QJsonParseError::NoError) {
+            reply = errorReply(parseError.errorString());
+        } else if (!document.isObject()) {
+            reply = errorReply("Request must be a JSON object");
+        } else {
+            reply = handleRequest(document.object());
+        }
+
+        socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact) + '\n');
+    }
+
+    if (socket->bytesAvailable() > MaxRequestBytes) {
+        socket->disconnectFromServer();
+    }
+}
+
+QJsonObject ScanDaemon::handleRequest(const QJsonObject& request) {
+    const QString query = request.value("query").toString();
+
+    if (query == "roots") {
+        QJsonArray list;
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        for (const auto& root : roots) {
+            QJsonObject entry{{"path", root->path}, {"scanning", root->scanning}};
+            if (!root->error.isEmpty()) {
+                entry.insert("error", root->error);
+            }
+            if (root->snapshot) {
+                entry.insert("scannedAt", root->snapshot->scannedAt.toString(Qt::ISODate));
+                entry.insert("totalSize", root->snapshot->totalSize);
+                entry.insert("fileCount", static_cast<qint64>(root->snapshot->files.size()));
+            }
+            list.append(entry);
+        }
+        return QJsonObject{{"ok", true}, {"roots", list}};
+    }
+
+    QString errorMessage;
+    const std::shared_ptr<const ScanIndex> index = snapshotFor(request.value("root").toString(), errorMessage);
+    if (!index) return errorReply(errorMessage);
+
+    const int limit = std::clamp(request.value("limit").toInt(DefaultLimit), 1, MaxLimit);
+    QString pathPrefix = request.value("path").toString();
+    if (!pathPrefix.isEmpty()) {
+        pathPrefix = QDir::cleanPath(pathPrefix);
+    }
+
+    QJsonObject reply{
+        {"ok", true},
+        {"root", index->root},
+        {"scannedAt", index->scannedAt.toString(Qt::ISODate)},
+    };
+
+    if (query == "files") {
+        // Largest first, so a plain top-K is just the head of the list
+        const QString typePrefix = request.value("type").toString();
+        const qint64 minSize = request.value("minSize").toInteger(0);
+
+        QJsonArray list;
+        for (const FileInfo& file : index->files) {
+            if (file.size < minSize || list.size() >= limit) break;
+            if (!pathPrefix.isEmpty() && !isUnderPath(file.path, pathPrefix)) continue;
+            if (!typePrefix.isEmpty() && !file.fileType.startsWith(typePrefix)) continue;
+            list.append(toJson(file));
+        }
+        reply.insert("files", list);
+    } else if (query == "directories") {
+        QJsonArray list;
+        for (const DirectoryTotal& dir : index->directories) {
+            if (list.size() >= limit) break;
+            if (!pathPrefix.isEmpty() && !isUnderPath(dir.path, pathPrefix)) continue;
+            list.append(QJsonObject{{"path", dir.path}, {"size", dir.size}, {"fileCount", dir.fileCount}});
+        }
+        reply.insert("directories", list);
+    } else if (query == "types") {
+        QVector<QPair<QString, TypeTotal>> totals;
+        totals.reserve(index->typeTotals.size());
+        for (auto it = index->typeTotals.constBegin(); it != index->typeTotals.constEnd(); ++it) {
+            totals.append({it.key(), it.value()});
+        }
+        std::sort(totals.begin(), totals.end(),
+                  [](const auto& a, const auto& b) { return a.second.size > b.second.size; });
+
+        QJsonArray list;
+        for (const auto& [type, total] : totals) {
+            if (list.size() >= limit) break;
+            list.append(QJsonObject{{"type", type}, {"size", total.size}, {"fileCount", total.fileCount}});
+        }
+        reply.insert("types", list);
+    } else {
+        return errorReply(QString("Unknown query \"%1\"").arg(query));
+    }
+
+    return reply;
+}
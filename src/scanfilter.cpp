@@ -0,0 +1,188 @@
+#include "scanfilter.h"
+#include "iothrottle.h"
+#include <QDir>
+#include <QFile>
+#include <QStorageInfo>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+static QStringList pathComponents(const QString& path) {
+    return QDir::cleanPath(QDir::fromNativeSeparators(path)).split('/', Qt::SkipEmptyParts);
+}
+
+ScanFilter::ScanFilter()
+    : pathNodes(1), detectLoops(true), skipHidden(false) {}
+
+ScanFilter ScanFilter::defaults() {
+    ScanFilter filter;
+
+    // Kernel pseudo filesystems report bogus sizes and never end
+    filter.excludePath("/proc");
+    filter.excludePath("/sys");
+    filter.excludePath("/dev");
+    filter.excludePath("/run");
+
+    // Snapshots duplicate the live tree and would inflate totals
+    filter.excludeName(".snapshot");
+    filter.excludeName(".snapshots");
+    filter.excludeName(".zfs");
+    filter.excludeName(".Trashes");
+
+    // Network and virtual mounts are slow and not local disk usage
+    filter.excludeFileSystemType("nfs");
+    filter.excludeFileSystemType("nfs4");
+    filter.excludeFileSystemType("cifs");
+    filter.excludeFileSystemType("smbfs");
+    filter.excludeFileSystemType("fuse");
+    filter.excludeFileSystemType("fuse.sshfs");
+    filter.excludeFileSystemType("tmpfs");
+    filter.excludeFileSystemType("devtmpfs");
+    filter.excludeFileSystemType("proc");
+    filter.excludeFileSystemType("sysfs");
+
+    return filter;
+}
+
+void ScanFilter::excludePath(const QString& prefix) {
+    int node = 0;
+    for (const QString& component : pathComponents(prefix)) {
+        auto it = pathNodes[node].children.find(component);
+        if (it != pathNodes[node].children.end()) {
+            node = it.value();
+        } else {
+            int child = static_cast<int>(pathNodes.size());
+            pathNodes[node].children.insert(component, child);
+            pathNodes.emplace_back();
+            node = child;
+        }
+    }
+    pathNodes[node].excluded = true;
+}
+
+void ScanFilter::excludeName(const QString& glob) {
+    // Plain names are the common case and only need a set lookup
+    if (glob.contains('*') || glob.contains('?') || glob.contains('[')) {
+        namePatterns.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(glob)));
+    } else {
+        exactNames.insert(glob);
+    }
+}
+
+void ScanFilter::excludeFileSystemType(const QString& type) {
+    fileSystemTypes.insert(type.toLower());
+}
+
+ScanFilter::Cursor ScanFilter::rootCursor(const QString& rootPath) const {
+    // The scan root itself is never excluded; only rules below it apply
+    Cursor cursor = 0;
+    for (const QString& component : pathComponents(rootPath)) {
+        cursor = childCursor(cursor, component);
+        if (cursor == NoCursor) break;
+    }
+    return cursor;
+}
+
+ScanFilter::Cursor ScanFilter::childCursor(Cursor parent, const QString& name) const {
+    if (parent == NoCursor) return NoCursor;
+    const auto& children = pathNodes[parent].children;
+    auto it = children.find(name);
+    return it != children.end() ? it.value() : NoCursor;
+}
+
+bool ScanFilter::isPathExcluded(Cursor cursor) const {
+    return cursor != NoCursor && pathNodes[cursor].excluded;
+}
+
+bool ScanFilter::excludesPath(const QString& path) const {
+    Cursor cursor = 0;
+    for (const QString& component : pathComponents(path)) {
+        cursor = childCursor(cursor, component);
+        if (cursor == NoCursor) return false;
+        if (pathNodes[cursor].excluded) return true;
+    }
+    return false;
+}
+
+bool ScanFilter::isNameExcluded(const QString& name) const {
+    if (exactNames.contains(name)) return true;
+    for (const QRegularExpression& pattern : namePatterns) {
+        if (pattern.match(name).hasMatch()) return true;
+    }
+    return false;
+}
+
+bool ScanFilter::isFileSystemTypeExcluded(const QString& type) const {
+    const QString lower = type.toLower();
+    if (fileSystemTypes.contains(lower)) return true;
+
+    // "fuse" also covers every "fuse.<driver>" subtype
+    int dot = lower.indexOf('.');
+    return dot > 0 && fileSystemTypes.contains(lower.left(dot));
+}
+
+ScanPruner::ScanPruner(const ScanFilter& filter, const QString& rootPath, IoThrottle *throttle)
+    : filter(filter), throttle(throttle), root(filter.rootCursor(rootPath)), rootDevice(0) {
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(rootPath).constData(), &st) == 0) {
+        rootDevice = static_cast<quint64>(st.st_dev);
+        visited.insert({rootDevice, static_cast<quint64>(st.st_ino)});
+    }
+#endif
+}
+
+bool ScanPruner::shouldDescend(const QString& path, const QString& name,
+                               ScanFilter::Cursor parentCursor,
+                               ScanFilter::Cursor& childCursor) {
+    if (filter.isNameExcluded(name)) return false;
+
+    childCursor = filter.childCursor(parentCursor, name);
+    if (filter.isPathExcluded(childCursor)) return false;
+
+#ifdef Q_OS_UNIX
+    if (!filter.hasFileSystemTypeRules() && !filter.loopDetectionEnabled()) return true;
+
+    if (throttle) {
+        throttle->acquireMetadata(1);
+    }
+
+    // Follows symlinks so a linked directory is identified by its target
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) return false;
+
+    const quint64 device = static_cast<quint64>(st.st_dev);
+    if (device != rootDevice && filter.hasFileSystemTypeRules() && isDeviceExcluded(device, path)) {
+        return false;
+    }
+
+    if (filter.loopDetectionEnabled()) {
+        // Symlink cycles and bind mounts both lead back to a seen inode
+        std::lock_guard<std::mutex> lock(visitedMutex);
+        const QPair<quint64, quint64> key{device, static_cast<quint64>(st.st_ino)};
+        if (visited.contains(key)) return false;
+        visited.insert(key);
+    }
+#else
+    Q_UNUSED(path);
+#endif
+
+    return true;
+}
+
+bool ScanPruner::isDeviceExcluded(quint64 device, const QString& path) {
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        auto it = deviceExcluded.find(device);
+        if (it != deviceExcluded.end()) return it.value();
+    }
+
+    // Only reached once per mount, so the mount table lookup is affordable
+    bool excluded = filter.isFileSystemTypeExcluded(
+        QString::fromLatin1(QStorageInfo(path).fileSystemType()));
+
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    deviceExcluded.insert(device, excluded);
+    return excluded;
+}
@@ -0,0 +1,41 @@
+#include "scanindex.h"
+#include <QDir>
+#include <algorithm>
+
+std::shared_ptr<const ScanIndex> ScanIndex::build(const QString& root, QList<FileInfo> files) {
+    auto index = std::make_shared<ScanIndex>();
+    index->root = QDir::cleanPath(root);
+    index->scannedAt = QDateTime::currentDateTimeUtc();
+
+    // Charge every file to each of its ancestors up to and including the root
+    QHash<QString, DirectoryTotal> directories;
+    for (const FileInfo& file : std::as_const(files)) {
+        index->totalSize += file.size;
+
+        TypeTotal& type = index->typeTotals[file.fileType];
+        type.fileCount++;
+        type.size += file.size;
+
+        QString dir = file.path;
+        int slash;
+        while ((slash = dir.lastIndexOf('/')) >= 0 && dir.size() > index->root.size()) {
+            dir.truncate(slash == 0 ? 1 : slash);
+            auto it = directories.find(dir);
+            if (it == directories.end()) {
+                it = directories.insert(dir, {dir, 0, 0});
+            }
+            it->size += file.size;
+            it->fileCount++;
+        }
+    }
+
+    index->directories.reserve(directories.size());
+    for (const DirectoryTotal& total : std::as_const(directories)) {
+        index->directories.append(total);
+    }
+    std::sort(index->directories.begin(), index->directories.end(),
+              [](const DirectoryTotal& a, const DirectoryTotal& b) { return a.size > b.size; });
+
+    index->files = std::move(files);
+    return index;
+}
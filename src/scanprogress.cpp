@@ -0,0 +1,165 @@
+#include "scanprogress.h"
+#include "scanfilter.h"
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QVector>
+#include <QStorageInfo>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/statvfs.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#endif
+
+struct MountEntry {
+    QString mountPoint;
+    QString fileSystemType;
+    QByteArray device;
+};
+
+#ifdef Q_OS_LINUX
+// mountinfo escapes space, tab, newline and backslash as \ooo
+static QString unescapeMountPath(const QByteArray& field) {
+    QByteArray path;
+    path.reserve(field.size());
+    for (int i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            bool ok = false;
+            const int value = field.mid(i + 1, 3).toInt(&ok, 8);
+            if (ok) {
+                path.append(static_cast<char>(value));
+                i += 3;
+                continue;
+            }
+        }
+        path.append(field[i]);
+    }
+    return QFile::decodeName(path);
+}
+
+static QByteArray deviceKey(dev_t device) {
+    return QByteArray::number(major(device)) + ':' + QByteArray::number(minor(device));
+}
+#endif
+
+// Lists mounts from the kernel's table without touching them, so a hung
+// network mount elsewhere on the host cannot stall the start of a scan
+static QVector<MountEntry> listMounts() {
+    QVector<MountEntry> mounts;
+#ifdef Q_OS_LINUX
+    QFile mountInfo("/proc/self/mountinfo");
+    if (!mountInfo.open(QIODevice::ReadOnly)) return mounts;
+
+    // id parent major:minor root mount-point options [optional...] - type source super-options
+    for (const QByteArray& line : mountInfo.readAll().split('\n')) {
+        const QList<QByteArray> fields = line.split(' ');
+        const int separator = fields.indexOf(QByteArray("-"));
+        if (fields.size() < 5 || separator < 0 || separator + 1 >= fields.size()) continue;
+        mounts.append({unescapeMountPath(fields[4]), QString::fromLatin1(fields[separator + 1]), fields[2]});
+    }
+#else
+    // Elsewhere QStorageInfo reads the mount table; volumes are only queried below
+    for (const QStorageInfo& volume : QStorageInfo::mountedVolumes()) {
+        mounts.append({volume.rootPath(), QString::fromLatin1(volume.fileSystemType()), volume.device()});
+    }
+#endif
+    return mounts;
+}
+
+ScanProgressTracker::ScanProgressTracker(const QString& rootPath, const ScanFilter& filter)
+    : estimatedBytes(0), estimatedFiles(0) {
+    addVolumeUsage(rootPath);
+
+    // Traversal crosses into other mounts, so count the ones it will reach.
+    // Bind mounts and subvolumes share a device and are only counted once.
+    const QString root = QDir::cleanPath(rootPath);
+    const QString prefix = root.endsWith('/') ? root : root + '/';
+
+    QSet<QByteArray> devices;
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::stat(QFile::encodeName(rootPath).constData(), &st) == 0) {
+        devices.insert(deviceKey(st.st_dev));
+    }
+#else
+    devices.insert(QStorageInfo(rootPath).device());
+#endif
+
+    for (const MountEntry& mount : listMounts()) {
+        // Cheap string checks first; only survivors are ever statvfs'ed
+        if (!mount.mountPoint.startsWith(prefix)) continue;
+        if (devices.contains(mount.device)) continue;
+        if (filter.isFileSystemTypeExcluded(mount.fileSystemType)) continue;
+        if (filter.excludesPath(mount.mountPoint)) continue;
+
+        bool pruned = false;
+        for (const QString& name : mount.mountPoint.mid(prefix.size()).split('/', Qt::SkipEmptyParts)) {
+            if (filter.isNameExcluded(name) || (filter.skipsHidden() && name.startsWith('.'))) {
+                pruned = true;
+                break;
+            }
+        }
+        if (pruned) continue;
+
+        devices.insert(mount.device);
+        addVolumeUsage(mount.mountPoint);
+    }
+
+    elapsed.start();
+}
+
+void ScanProgressTracker::addVolumeUsage(const QString& path) {
+#ifdef Q_OS_UNIX
+    struct statvfs fs;
+    if (::statvfs(QFile::encodeName(path).constData(), &fs) == 0) {
+        estimatedBytes += static_cast<qint64>(fs.f_blocks - fs.f_bfree) * static_cast<qint64>(fs.f_frsize);
+        // Used inodes include directories, so this slightly overestimates files
+        if (fs.f_files > fs.f_ffree) {
+            estimatedFiles += static_cast<qint64>(fs.f_files - fs.f_ffree);
+        }
+    }
+#else
+    QStorageInfo storage(path);
+    if (storage.isValid()) {
+        estimatedBytes += storage.bytesTotal() - storage.bytesFree();
+    }
+#endif
+}
+
+ScanProgress ScanProgressTracker::sample() const {
+    ScanProgress progress;
+    progress.filesScanned = files.load(std::memory_order_relaxed);
+    progress.bytesScanned = bytes.load(std::memory_order_relaxed);
+    progress.directoriesScanned = directories.load(std::memory_order_relaxed);
+
+    const double seconds = elapsed.elapsed() / 1000.0;
+    if (seconds > 0) {
+        progress.filesPerSecond = progress.filesScanned / seconds;
+        progress.bytesPerSecond = progress.bytesScanned / seconds;
+    }
+
+    // Apparent sizes can undercount allocated blocks and vice versa, so take
+    // whichever of the two estimates is further along
+    double fraction = 0;
+    if (estimatedBytes > 0) {
+        fraction = std::max(fraction, static_cast<double>(progress.bytesScanned) / estimatedBytes);
+    }
+    if (estimatedFiles > 0) {
+        fraction = std::max(fraction, static_cast<double>(progress.filesScanned) / estimatedFiles);
+    }
+
+    // Never report completion before the scan actually finishes
+    fraction = std::min(fraction, 0.99);
+    progress.percentage = static_cast<int>(fraction * 100);
+
+    if (fraction > 0.01 && seconds > 1) {
+        progress.etaSeconds = static_cast<qint64>(seconds * (1 - fraction) / fraction);
+    }
+
+    return progress;
+}